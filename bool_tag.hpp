@@ -0,0 +1,13 @@
+#ifndef BOOL_TAG_HPP
+#define BOOL_TAG_HPP
+
+namespace my {
+namespace type_traits {
+
+  // for tag dispatching on a compile time condition
+  template <bool B>
+  struct bool_tag {};
+
+}}
+
+#endif
@@ -0,0 +1,14 @@
+#ifndef IS_SAME_HPP
+#define IS_SAME_HPP
+
+namespace my {
+namespace type_traits {
+
+  template <class T, class U>
+  struct is_same { enum { value = false }; };
+  template <class T>
+  struct is_same<T, T> { enum { value = true }; };
+
+}}
+
+#endif
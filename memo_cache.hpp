@@ -0,0 +1,341 @@
+#ifndef MEMO_CACHE_HPP
+#define MEMO_CACHE_HPP
+
+#include <cstddef>
+#include <string>
+#include "optional.hpp"
+#include "spinlock.hpp"
+#include "static_assert.hpp"
+
+#if defined(MY_MEMO_CACHE_TIMING)
+#include <time.h>
+#endif
+
+namespace my
+{
+  namespace detail
+  {
+    // 64bit finalizer of MurmurHash3, spreads every input bit over the low bits used for indexing
+    inline std::size_t memo_mix(unsigned long long x) MY_NOEXCEPT
+    {
+      x ^= x >> 33;
+      x *= 0xff51afd7ed558ccdULL;
+      x ^= x >> 33;
+      x *= 0xc4ceb9fe1a85ec53ULL;
+      x ^= x >> 33;
+      return static_cast<std::size_t>(x);
+    }
+
+#if defined(MY_MEMO_CACHE_TIMING)
+    inline unsigned long long memo_now_ns() MY_NOEXCEPT
+    {
+      timespec ts;
+      clock_gettime(CLOCK_MONOTONIC, &ts);
+      return static_cast<unsigned long long>(ts.tv_sec) * 1000000000ULL + ts.tv_nsec;
+    }
+#endif
+  }
+
+  template <class K>
+  struct memo_hash;
+
+#define MY_MEMO_HASH_INTEGRAL(type) \
+  template <> \
+  struct memo_hash<type> \
+  { \
+    std::size_t operator()(type k) const MY_NOEXCEPT { return detail::memo_mix(static_cast<unsigned long long>(k)); } \
+  }
+
+  MY_MEMO_HASH_INTEGRAL(bool);
+  MY_MEMO_HASH_INTEGRAL(char);
+  MY_MEMO_HASH_INTEGRAL(signed char);
+  MY_MEMO_HASH_INTEGRAL(unsigned char);
+  MY_MEMO_HASH_INTEGRAL(short);
+  MY_MEMO_HASH_INTEGRAL(unsigned short);
+  MY_MEMO_HASH_INTEGRAL(int);
+  MY_MEMO_HASH_INTEGRAL(unsigned int);
+  MY_MEMO_HASH_INTEGRAL(long);
+  MY_MEMO_HASH_INTEGRAL(unsigned long);
+  MY_MEMO_HASH_INTEGRAL(long long);
+  MY_MEMO_HASH_INTEGRAL(unsigned long long);
+
+#undef MY_MEMO_HASH_INTEGRAL
+
+  template <class T>
+  struct memo_hash<T*>
+  {
+    std::size_t operator()(T* k) const MY_NOEXCEPT { return detail::memo_mix(reinterpret_cast<std::size_t>(k)); }
+  };
+
+  template <>
+  struct memo_hash<std::string>
+  {
+    // FNV-1a
+    std::size_t operator()(const std::string& k) const MY_NOEXCEPT
+    {
+      unsigned long long h = 0xcbf29ce484222325ULL;
+      for (std::string::size_type i = 0; i < k.size(); ++i)
+      {
+        h ^= static_cast<unsigned char>(k[i]);
+        h *= 0x100000001b3ULL;
+      }
+      return detail::memo_mix(h);
+    }
+  };
+
+  struct memo_cache_stats
+  {
+    unsigned long long lookups;
+    unsigned long long hits;
+    unsigned long long misses;
+    unsigned long long evictions;
+    unsigned long long lookup_ns; // only accumulated when MY_MEMO_CACHE_TIMING is defined
+
+    memo_cache_stats(): lookups(0), hits(0), misses(0), evictions(0), lookup_ns(0) {}
+    double hit_rate() const MY_NOEXCEPT { return lookups ? static_cast<double>(hits) / lookups : 0.0; }
+    double mean_lookup_ns() const MY_NOEXCEPT { return lookups ? static_cast<double>(lookup_ns) / lookups : 0.0; }
+    memo_cache_stats& operator+=(const memo_cache_stats& other) MY_NOEXCEPT
+    {
+      lookups += other.lookups;
+      hits += other.hits;
+      misses += other.misses;
+      evictions += other.evictions;
+      lookup_ns += other.lookup_ns;
+      return *this;
+    }
+  };
+
+  // Fixed size memoization cache without heap allocation.
+  // N slots are split into N / Ways sets; Ways == 1 is direct-mapped, Ways == 2 is 2-way set-associative with LRU eviction.
+  // Not thread safe, see sharded_memo_cache.
+  template <class K, class V, std::size_t N, std::size_t Ways = 1, class Hash = memo_hash<K> >
+  class memo_cache
+  {
+  public:
+    typedef K key_type;
+    typedef V mapped_type;
+    enum { capacity = N, ways = Ways, sets = N / Ways };
+  private:
+    STATIC_ASSERT(Ways == 1 || Ways == 2, memo_cache_supports_only_1_or_2_ways);
+    STATIC_ASSERT(N > 0 && N % Ways == 0, memo_cache_size_must_be_multiple_of_ways);
+
+    struct slot
+    {
+      optional<K> key;
+      optional<V> value; // slot is occupied iff value is engaged
+    };
+
+    slot slots[N];
+    unsigned char victims[Ways == 2 ? sets : 1]; // way to evict next per set, unused for Ways == 1
+    Hash hasher;
+    memo_cache_stats counters;
+    unsigned long generation; // bumped whenever slots change, lets get_or_compute skip rescanning the set after f
+
+    memo_cache(const memo_cache&);
+    memo_cache& operator=(const memo_cache&);
+
+    slot* set_of(const K& k) { return slots + hasher(k) % sets * Ways; }
+    static slot* find_in_set(slot* set, const K& k)
+    {
+      for (std::size_t w = 0; w < Ways; ++w)
+      {
+        if (set[w].value && *set[w].key == k) return set + w;
+      }
+      return NULL;
+    }
+    void touch(slot* set, slot* s) MY_NOEXCEPT
+    {
+      if (Ways == 2) victims[(set - slots) / Ways] = static_cast<unsigned char>(s == set);
+    }
+    slot* victim_of(slot* set) MY_NOEXCEPT
+    {
+      for (std::size_t w = 0; w < Ways; ++w)
+      {
+        if (!set[w].value) return set + w;
+      }
+      ++counters.evictions;
+      return set + (Ways == 2 ? victims[(set - slots) / Ways] : 0);
+    }
+    slot* find(slot* set, const K& k)
+    {
+#if defined(MY_MEMO_CACHE_TIMING)
+      unsigned long long start = detail::memo_now_ns();
+#endif
+      slot* s = find_in_set(set, k);
+      ++counters.lookups;
+      if (s)
+      {
+        ++counters.hits;
+        this->touch(set, s);
+      }
+      else ++counters.misses;
+#if defined(MY_MEMO_CACHE_TIMING)
+      counters.lookup_ns += detail::memo_now_ns() - start;
+#endif
+      return s;
+    }
+    // s is the slot already holding k, or NULL if k is known not to be in the set
+    template <class U>
+    void store(slot* set, slot* s, const K& k, const U& val)
+    {
+      if (!s)
+      {
+        s = this->victim_of(set);
+        s->value.reset();
+        s->key = k;
+      }
+      s->value = val;
+      this->touch(set, s);
+      ++generation;
+    }
+  public:
+    explicit memo_cache(const Hash& hasher = Hash()): hasher(hasher), generation(0)
+    {
+      for (std::size_t i = 0; i < sizeof(victims); ++i) victims[i] = 0;
+    }
+
+    optional<V> lookup(const K& k)
+    {
+      slot* s = this->find(this->set_of(k), k);
+      return s ? s->value : optional<V>();
+    }
+    // f(k) is evaluated only on a miss, before any slot is touched, so f may itself memoize through
+    // this cache, and a throwing f leaves the cache as it was. The result is copied into the slot.
+    template <class F>
+    V get_or_compute(const K& k, F f)
+    {
+      slot* set = this->set_of(k);
+      slot* s = this->find(set, k);
+      if (s) return *s->value;
+      unsigned long before = generation;
+      V val = f(k);
+      // a nested call may have stored k meanwhile
+      this->store(set, generation == before ? NULL : find_in_set(set, k), k, val);
+      return val;
+    }
+    template <class U>
+    void insert(const K& k, const U& val)
+    {
+      slot* set = this->set_of(k);
+      this->store(set, find_in_set(set, k), k, val);
+    }
+    bool erase(const K& k)
+    {
+      slot* s = find_in_set(this->set_of(k), k);
+      if (!s) return false;
+      s->value.reset();
+      s->key.reset();
+      ++generation;
+      return true;
+    }
+    void clear() MY_NOEXCEPT
+    {
+      ++generation;
+      for (std::size_t i = 0; i < N; ++i)
+      {
+        slots[i].value.reset();
+        slots[i].key.reset();
+      }
+    }
+
+    const memo_cache_stats& stats() const MY_NOEXCEPT { return counters; }
+    void reset_stats() MY_NOEXCEPT { counters = memo_cache_stats(); }
+  };
+
+  // Thread safe memo_cache split into Shards independent caches, each guarded by its own spinlock.
+  // get_or_compute does not hold the lock while f runs, so two threads missing on the same key may both compute it.
+  template <class K, class V, std::size_t N, std::size_t Shards, std::size_t Ways = 1, class Hash = memo_hash<K> >
+  class sharded_memo_cache
+  {
+  public:
+    typedef K key_type;
+    typedef V mapped_type;
+    enum { capacity = N, shards = Shards, ways = Ways };
+  private:
+    STATIC_ASSERT(Shards > 0 && N % Shards == 0, sharded_memo_cache_size_must_be_multiple_of_shards);
+
+    typedef memo_cache<K, V, N / Shards, Ways, Hash> cache_type;
+    struct shard
+    {
+      spinlock lock;
+      cache_type cache;
+      char padding[64]; // keep neighbouring locks off the same cache line
+    };
+
+    shard shard_array[Shards];
+    Hash hasher;
+
+    sharded_memo_cache(const sharded_memo_cache&);
+    sharded_memo_cache& operator=(const sharded_memo_cache&);
+
+    // rehash so that the shard index is not correlated with the set index inside the shard
+    shard& shard_of(const K& k) { return shard_array[detail::memo_mix(hasher(k)) % Shards]; }
+  public:
+    sharded_memo_cache() {}
+
+    optional<V> lookup(const K& k)
+    {
+      shard& s = this->shard_of(k);
+      lock_guard<spinlock> guard(s.lock);
+      return s.cache.lookup(k);
+    }
+    template <class F>
+    V get_or_compute(const K& k, F f)
+    {
+      shard& s = this->shard_of(k);
+      {
+        lock_guard<spinlock> guard(s.lock);
+        optional<V> cached = s.cache.lookup(k);
+        if (cached) return *cached;
+      }
+      V val = f(k);
+      {
+        lock_guard<spinlock> guard(s.lock);
+        s.cache.insert(k, val);
+      }
+      return val;
+    }
+    template <class U>
+    void insert(const K& k, const U& val)
+    {
+      shard& s = this->shard_of(k);
+      lock_guard<spinlock> guard(s.lock);
+      s.cache.insert(k, val);
+    }
+    bool erase(const K& k)
+    {
+      shard& s = this->shard_of(k);
+      lock_guard<spinlock> guard(s.lock);
+      return s.cache.erase(k);
+    }
+    void clear()
+    {
+      for (std::size_t i = 0; i < Shards; ++i)
+      {
+        lock_guard<spinlock> guard(shard_array[i].lock);
+        shard_array[i].cache.clear();
+      }
+    }
+
+    memo_cache_stats stats()
+    {
+      memo_cache_stats total;
+      for (std::size_t i = 0; i < Shards; ++i)
+      {
+        lock_guard<spinlock> guard(shard_array[i].lock);
+        total += shard_array[i].cache.stats();
+      }
+      return total;
+    }
+    void reset_stats()
+    {
+      for (std::size_t i = 0; i < Shards; ++i)
+      {
+        lock_guard<spinlock> guard(shard_array[i].lock);
+        shard_array[i].cache.reset_stats();
+      }
+    }
+  };
+}
+
+#endif
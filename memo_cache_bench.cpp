@@ -0,0 +1,165 @@
+#include <cstdio>
+#include <map>
+#include <vector>
+#include <pthread.h>
+#include <time.h>
+#include "memo_cache.hpp"
+
+// Compares memo_cache / sharded_memo_cache against the std::map + mutex memoization they replace.
+// Keys are drawn from a skewed distribution so that a fixed size cache sees both hits and evictions.
+
+namespace
+{
+  const std::size_t key_space = 1 << 14;
+  const std::size_t ops_per_thread = 1 << 22;
+  const int thread_count = 4;
+
+  unsigned long long now_ns()
+  {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<unsigned long long>(ts.tv_sec) * 1000000000ULL + ts.tv_nsec;
+  }
+
+  std::vector<unsigned> make_keys(unsigned seed)
+  {
+    std::vector<unsigned> keys(ops_per_thread);
+    unsigned x = seed;
+    for (std::size_t i = 0; i < keys.size(); ++i)
+    {
+      x = x * 1664525u + 1013904223u;
+      // product of two uniforms favours small keys
+      unsigned a = (x >> 8) % key_space;
+      x = x * 1664525u + 1013904223u;
+      unsigned b = (x >> 8) % key_space;
+      keys[i] = static_cast<unsigned>(static_cast<unsigned long long>(a) * b / key_space);
+    }
+    return keys;
+  }
+
+  // stands in for route parsing / symbol resolution
+  struct expensive
+  {
+    unsigned long long operator()(unsigned k) const
+    {
+      unsigned long long h = k;
+      for (int i = 0; i < 64; ++i) h = h * 6364136223846793005ULL + 1442695040888963407ULL;
+      return h;
+    }
+  };
+
+  class map_cache
+  {
+  private:
+    std::map<unsigned, unsigned long long> table;
+    pthread_mutex_t mutex;
+  public:
+    map_cache() { pthread_mutex_init(&mutex, NULL); }
+    ~map_cache() { pthread_mutex_destroy(&mutex); }
+    unsigned long long get_or_compute(unsigned k, expensive f)
+    {
+      pthread_mutex_lock(&mutex);
+      std::map<unsigned, unsigned long long>::iterator it = table.find(k);
+      if (it != table.end())
+      {
+        unsigned long long v = it->second;
+        pthread_mutex_unlock(&mutex);
+        return v;
+      }
+      pthread_mutex_unlock(&mutex);
+      unsigned long long v = f(k);
+      pthread_mutex_lock(&mutex);
+      table.insert(std::make_pair(k, v));
+      pthread_mutex_unlock(&mutex);
+      return v;
+    }
+  };
+
+  typedef my::memo_cache<unsigned, unsigned long long, 4096, 2> local_cache;
+  typedef my::sharded_memo_cache<unsigned, unsigned long long, 4096, 16, 2> shared_cache;
+
+  template <class Cache>
+  struct worker
+  {
+    Cache* cache;
+    const std::vector<unsigned>* keys;
+    unsigned long long checksum;
+
+    static void* run(void* arg)
+    {
+      worker* w = static_cast<worker*>(arg);
+      unsigned long long sum = 0;
+      for (std::size_t i = 0; i < w->keys->size(); ++i) sum += w->cache->get_or_compute((*w->keys)[i], expensive());
+      w->checksum = sum;
+      return NULL;
+    }
+  };
+
+  template <class Cache>
+  double run_threads(Cache& cache, const std::vector<std::vector<unsigned> >& keys, int threads, unsigned long long& checksum)
+  {
+    std::vector<pthread_t> ids(threads);
+    std::vector<worker<Cache> > workers(threads);
+    unsigned long long start = now_ns();
+    for (int i = 0; i < threads; ++i)
+    {
+      workers[i].cache = &cache;
+      workers[i].keys = &keys[i];
+      pthread_create(&ids[i], NULL, &worker<Cache>::run, &workers[i]);
+    }
+    checksum = 0;
+    for (int i = 0; i < threads; ++i)
+    {
+      pthread_join(ids[i], NULL);
+      checksum += workers[i].checksum;
+    }
+    return static_cast<double>(now_ns() - start) / (static_cast<double>(ops_per_thread) * threads);
+  }
+
+  void report(const char* name, int threads, double ns_per_op, unsigned long long checksum)
+  {
+    std::printf("%-28s threads=%d  %8.2f ns/op  (checksum %llx)\n", name, threads, ns_per_op, checksum);
+  }
+  void report(const char* name, int threads, double ns_per_op, unsigned long long checksum, const my::memo_cache_stats& stats)
+  {
+    std::printf("%-28s threads=%d  %8.2f ns/op  hit rate %5.1f%%  evictions %llu  (checksum %llx)\n",
+                name, threads, ns_per_op, stats.hit_rate() * 100, stats.evictions, checksum);
+#if defined(MY_MEMO_CACHE_TIMING)
+    std::printf("%-28s mean lookup latency %.2f ns\n", "", stats.mean_lookup_ns());
+#endif
+  }
+}
+
+int main()
+{
+  std::vector<std::vector<unsigned> > keys;
+  for (int i = 0; i < thread_count; ++i) keys.push_back(make_keys(12345u + i));
+  unsigned long long checksum;
+
+  {
+    map_cache cache;
+    double t = run_threads(cache, keys, 1, checksum);
+    report("std::map + mutex", 1, t, checksum);
+  }
+  {
+    static local_cache cache;
+    double t = run_threads(cache, keys, 1, checksum);
+    report("memo_cache<4096, 2-way>", 1, t, checksum, cache.stats());
+  }
+  {
+    static shared_cache cache;
+    double t = run_threads(cache, keys, 1, checksum);
+    report("sharded_memo_cache<16>", 1, t, checksum, cache.stats());
+  }
+  {
+    map_cache cache;
+    double t = run_threads(cache, keys, thread_count, checksum);
+    report("std::map + mutex", thread_count, t, checksum);
+  }
+  {
+    static shared_cache cache;
+    double t = run_threads(cache, keys, thread_count, checksum);
+    report("sharded_memo_cache<16>", thread_count, t, checksum, cache.stats());
+  }
+  return 0;
+}
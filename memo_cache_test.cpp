@@ -0,0 +1,191 @@
+#define BOOST_TEST_MAIN
+#include <boost/test/included/unit_test.hpp>
+#include <string>
+#include <vector>
+#include <pthread.h>
+#include "memo_cache.hpp"
+
+using namespace my;
+
+// identity hash so that tests can choose which set a key lands in
+struct identity_hash
+{
+  std::size_t operator()(int k) const { return static_cast<std::size_t>(k); }
+};
+
+struct square
+{
+  int* calls;
+  explicit square(int* calls): calls(calls) {}
+  int operator()(int k) const { ++*calls; return k * k; }
+};
+
+struct throwing_compute
+{
+  int operator()(int) const { throw bad_optional_access(); }
+};
+
+// memoizes f(k - 1) through the same cache, as symbol resolution does
+struct recursive_sum
+{
+  memo_cache<int, int, 1>* cache;
+  explicit recursive_sum(memo_cache<int, int, 1>* cache): cache(cache) {}
+  int operator()(int k) const { return k <= 0 ? 0 : k + cache->get_or_compute(k - 1, *this); }
+};
+
+typedef sharded_memo_cache<int, int, 64, 4, 2> shared_cache;
+const int thread_keys = 200;
+const int thread_rounds = 50;
+
+struct sharded_worker
+{
+  shared_cache* cache;
+  int id;
+  int wrong;
+  unsigned long long lookups;
+
+  static void* run(void* arg)
+  {
+    sharded_worker* w = static_cast<sharded_worker*>(arg);
+    int calls = 0;
+    for (int r = 0; r < thread_rounds; ++r)
+    {
+      // threads walk the same keys from different offsets so that they collide in every shard
+      for (int i = 0; i < thread_keys; ++i)
+      {
+        int k = (i + w->id * 37) % thread_keys;
+        if (w->cache->get_or_compute(k, square(&calls)) != k * k) ++w->wrong;
+        ++w->lookups;
+        if (i % 3 == 0) w->cache->insert(k, k * k);
+        optional<int> v = w->cache->lookup(k);
+        ++w->lookups;
+        if (v && *v != k * k) ++w->wrong;
+      }
+    }
+    return NULL;
+  }
+};
+
+std::string describe(const std::string& k) { return "route:" + k; }
+
+BOOST_AUTO_TEST_SUITE(my_memo_cache)
+BOOST_AUTO_TEST_CASE(direct_mapped) {
+  memo_cache<int, int, 8, 1, identity_hash> cache;
+  BOOST_CHECK(!cache.lookup(1));
+
+  int calls = 0;
+  BOOST_CHECK_EQUAL(cache.get_or_compute(3, square(&calls)), 9);
+  BOOST_CHECK_EQUAL(cache.get_or_compute(3, square(&calls)), 9);
+  BOOST_CHECK_EQUAL(calls, 1);
+  BOOST_CHECK(cache.lookup(3) == 9);
+
+  // 11 maps to the same set as 3 and evicts it
+  cache.insert(11, 121);
+  BOOST_CHECK(cache.lookup(11) == 121);
+  BOOST_CHECK(cache.lookup(3) == nullopt);
+  BOOST_CHECK_EQUAL(cache.stats().evictions, 1u);
+
+  BOOST_CHECK(cache.erase(11));
+  BOOST_CHECK(!cache.erase(11));
+  BOOST_CHECK(!cache.lookup(11));
+}
+BOOST_AUTO_TEST_CASE(two_way_lru) {
+  memo_cache<int, int, 8, 2, identity_hash> cache;
+  // 0, 4 and 8 all map to set 0
+  cache.insert(0, 0);
+  cache.insert(4, 40);
+  BOOST_CHECK(cache.lookup(0) == 0);
+  cache.insert(8, 80); // evicts 4, the least recently used
+  BOOST_CHECK(cache.lookup(0) == 0);
+  BOOST_CHECK(cache.lookup(8) == 80);
+  BOOST_CHECK(!cache.lookup(4));
+
+  cache.insert(8, 81); // overwrite in place
+  BOOST_CHECK(cache.lookup(8) == 81);
+  BOOST_CHECK_EQUAL(cache.stats().evictions, 1u);
+
+  cache.clear();
+  BOOST_CHECK(!cache.lookup(0));
+  BOOST_CHECK(!cache.lookup(8));
+}
+BOOST_AUTO_TEST_CASE(stats) {
+  memo_cache<int, int, 16> cache;
+  int calls = 0;
+  cache.get_or_compute(1, square(&calls));
+  cache.get_or_compute(1, square(&calls));
+  cache.lookup(1);
+  cache.lookup(2);
+  BOOST_CHECK_EQUAL(cache.stats().lookups, 4u);
+  BOOST_CHECK_EQUAL(cache.stats().hits, 2u);
+  BOOST_CHECK_EQUAL(cache.stats().misses, 2u);
+  BOOST_CHECK_CLOSE(cache.stats().hit_rate(), 0.5, 1e-9);
+  cache.reset_stats();
+  BOOST_CHECK_EQUAL(cache.stats().lookups, 0u);
+  BOOST_CHECK_EQUAL(cache.stats().hit_rate(), 0.0);
+}
+BOOST_AUTO_TEST_CASE(compute_throws) {
+  memo_cache<int, int, 4> cache;
+  BOOST_CHECK_THROW(cache.get_or_compute(1, throwing_compute()), bad_optional_access);
+  BOOST_CHECK(!cache.lookup(1));
+  int calls = 0;
+  BOOST_CHECK_EQUAL(cache.get_or_compute(1, square(&calls)), 1);
+}
+BOOST_AUTO_TEST_CASE(recursive_compute) {
+  // every key shares the single slot, so the nested calls keep evicting each other
+  memo_cache<int, int, 1> cache;
+  BOOST_CHECK_EQUAL(cache.get_or_compute(2, recursive_sum(&cache)), 3);
+  BOOST_CHECK(cache.lookup(2) == 3);
+  BOOST_CHECK(!cache.lookup(1));
+  BOOST_CHECK_EQUAL(cache.get_or_compute(4, recursive_sum(&cache)), 10);
+  BOOST_CHECK(cache.lookup(4) == 10);
+}
+BOOST_AUTO_TEST_CASE(string_keys) {
+  memo_cache<std::string, std::string, 32, 2> cache;
+  BOOST_CHECK_EQUAL(cache.get_or_compute("a", describe), "route:a");
+  BOOST_CHECK(cache.lookup("a") == std::string("route:a"));
+  BOOST_CHECK(!cache.lookup("b"));
+}
+BOOST_AUTO_TEST_CASE(sharded) {
+  sharded_memo_cache<int, int, 64, 4, 2> cache;
+  int calls = 0;
+  for (int i = 0; i < 16; ++i) BOOST_CHECK_EQUAL(cache.get_or_compute(i, square(&calls)), i * i);
+  BOOST_CHECK(cache.lookup(5) == 25);
+  BOOST_CHECK(cache.erase(5));
+  BOOST_CHECK(!cache.lookup(5));
+  cache.insert(5, 26);
+  BOOST_CHECK(cache.lookup(5) == 26);
+  BOOST_CHECK_EQUAL(cache.stats().lookups, 19u);
+  cache.clear();
+  BOOST_CHECK(!cache.lookup(5));
+  cache.reset_stats();
+  BOOST_CHECK_EQUAL(cache.stats().lookups, 0u);
+}
+BOOST_AUTO_TEST_CASE(sharded_threads) {
+  shared_cache cache;
+  const int thread_count = 4;
+  std::vector<pthread_t> ids(thread_count);
+  std::vector<sharded_worker> workers(thread_count);
+  for (int i = 0; i < thread_count; ++i)
+  {
+    workers[i].cache = &cache;
+    workers[i].id = i;
+    workers[i].wrong = 0;
+    workers[i].lookups = 0;
+    BOOST_REQUIRE_EQUAL(pthread_create(&ids[i], NULL, &sharded_worker::run, &workers[i]), 0);
+  }
+  unsigned long long lookups = 0;
+  for (int i = 0; i < thread_count; ++i)
+  {
+    pthread_join(ids[i], NULL);
+    BOOST_CHECK_EQUAL(workers[i].wrong, 0);
+    lookups += workers[i].lookups;
+  }
+  BOOST_CHECK_EQUAL(cache.stats().lookups, lookups);
+  BOOST_CHECK_EQUAL(cache.stats().hits + cache.stats().misses, lookups);
+  for (int k = 0; k < thread_keys; ++k)
+  {
+    optional<int> v = cache.lookup(k);
+    BOOST_CHECK(!v || *v == k * k);
+  }
+}
+BOOST_AUTO_TEST_SUITE_END()
@@ -37,6 +37,8 @@ namespace my
     bool is_constructed() const MY_NOEXCEPT { return data; }
   };
 
+  // the optional_algorithm kernels read this layout directly (storage at offset 0, then data,
+  // which is null iff disengaged); detected_simd_level() checks it and falls back to scalar code
   template <class T>
   struct LocalStorage
   {
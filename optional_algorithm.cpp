@@ -0,0 +1,602 @@
+#include "optional_algorithm.hpp"
+#include <cstring>
+#include <limits>
+#include "static_assert.hpp"
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#define MY_OPTIONAL_SIMD
+#include <immintrin.h>
+// AVX2 kernels are compiled per function so the rest of the build does not need -mavx2
+#define MY_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+namespace my
+{
+namespace detail
+{
+namespace
+{
+  // scalar kernels are the generic loops, except sum of double which uses the same 4 partial sums as the SIMD kernels
+
+  template <class T>
+  std::size_t count_engaged_scalar(const optional<T>* p, std::size_t n) { return count_engaged(p, p + n, bool_tag<false>()); }
+  template <class T>
+  void fill_value_or_scalar(const optional<T>* p, std::size_t n, T* out, T val) { fill_value_or(p, p + n, out, val, bool_tag<false>()); }
+  template <class T>
+  bool equal_ranges_scalar(const optional<T>* p, const optional<T>* q, std::size_t n) { return equal_ranges(p, p + n, q, bool_tag<false>()); }
+  template <class T>
+  bool min_engaged_scalar(const optional<T>* p, std::size_t n, T* out)
+  {
+    optional<T> m = min_engaged(p, p + n, bool_tag<false>());
+    if (m) *out = *m;
+    return m.has_value();
+  }
+  template <class T>
+  bool max_engaged_scalar(const optional<T>* p, std::size_t n, T* out)
+  {
+    optional<T> m = max_engaged(p, p + n, bool_tag<false>());
+    if (m) *out = *m;
+    return m.has_value();
+  }
+
+  double sum_partials(const optional<double>* p, std::size_t i, std::size_t n, double* partial)
+  {
+    for (; i < n; ++i)
+    {
+      if (p[i]) partial[i % 4] += *p[i];
+    }
+    return (partial[0] + partial[1]) + (partial[2] + partial[3]);
+  }
+  double sum_engaged_scalar(const optional<double>* p, std::size_t n)
+  {
+    double partial[4] = { 0.0, 0.0, 0.0, 0.0 };
+    return sum_partials(p, 0, n, partial);
+  }
+  int32_t sum_engaged_scalar(const optional<int32_t>* p, std::size_t n)
+  {
+    // accumulate unsigned so that overflow wraps like the SIMD kernels instead of being undefined
+    uint32_t sum = 0;
+    for (std::size_t i = 0; i < n; ++i)
+    {
+      if (p[i]) sum += static_cast<uint32_t>(*p[i]);
+    }
+    return static_cast<int32_t>(sum);
+  }
+
+  template <class T>
+  struct scalar_kernels
+  {
+    static const optional_kernels<T> table;
+  };
+  template <class T>
+  const optional_kernels<T> scalar_kernels<T>::table = {
+    &count_engaged_scalar<T>,
+    &sum_engaged_scalar,
+    &fill_value_or_scalar<T>,
+    &equal_ranges_scalar<T>,
+    &min_engaged_scalar<T>,
+    &max_engaged_scalar<T>
+  };
+
+#if defined(MY_OPTIONAL_SIMD)
+  // The kernels read optional<T, LocalStorage> as raw memory: the value at offset 0 followed by the
+  // pointer LocalStorage keeps to it, which is non-null iff the optional is engaged.
+  // Values of disengaged elements are read too but always masked out.
+  STATIC_ASSERT(sizeof(optional<double>) == 16, optional_double_layout_is_value_and_pointer);
+  STATIC_ASSERT(sizeof(optional<int32_t>) == 16, optional_int32_layout_is_value_padding_and_pointer);
+
+  // sizeof alone does not catch reordered members, so look at the bytes of real objects
+  template <class T>
+  bool has_kernel_layout(T val)
+  {
+    optional<T> engaged(val), disengaged;
+    const unsigned char* e = reinterpret_cast<const unsigned char*>(&engaged);
+    const unsigned char* d = reinterpret_cast<const unsigned char*>(&disengaged);
+    const void* self = &engaged;
+    const void* null = NULL;
+    return std::memcmp(e, &val, sizeof(T)) == 0
+      && std::memcmp(e + 8, &self, sizeof(void*)) == 0
+      && std::memcmp(d + 8, &null, sizeof(void*)) == 0;
+  }
+
+  // first engaged element is NaN (operator< never replaces it) or the result is the extreme of the
+  // engaged non-NaN values; among equal values the first one wins, which only matters for -0.0 and 0.0
+  template <double (*Reduce)(const optional<double>*, std::size_t)>
+  bool extreme_engaged(const optional<double>* p, std::size_t n, double* out)
+  {
+    std::size_t first = 0;
+    while (first < n && !p[first]) ++first;
+    if (first == n) return false;
+    double result = *p[first];
+    if (result == result) result = Reduce(p + first, n - first);
+    if (result == 0.0)
+    {
+      for (std::size_t i = first; ; ++i)
+      {
+        if (p[i] && *p[i] == 0.0)
+        {
+          result = *p[i];
+          break;
+        }
+      }
+    }
+    *out = result;
+    return true;
+  }
+
+  // movemask results have at most 8 bits; __builtin_popcount is a library call unless the build enables popcnt
+  inline std::size_t count_bits(int mask)
+  {
+    static const unsigned char nibble_bits[16] = { 0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4 };
+    return nibble_bits[mask & 0xf] + nibble_bits[(mask >> 4) & 0xf];
+  }
+
+  // ---- SSE2 ----
+
+  struct double_pair
+  {
+    __m128d values;
+    __m128d engaged;
+  };
+  // p[0], p[1]
+  inline double_pair load_sse2(const optional<double>* p)
+  {
+    __m128d o0 = _mm_loadu_pd(reinterpret_cast<const double*>(p));
+    __m128d o1 = _mm_loadu_pd(reinterpret_cast<const double*>(p + 1));
+    // SSE2 has no 64bit compare, a pointer is null iff both of its 32bit halves are
+    __m128i null = _mm_cmpeq_epi32(_mm_castpd_si128(_mm_unpackhi_pd(o0, o1)), _mm_setzero_si128());
+    null = _mm_and_si128(null, _mm_shuffle_epi32(null, _MM_SHUFFLE(2, 3, 0, 1)));
+    double_pair r;
+    r.values = _mm_unpacklo_pd(o0, o1);
+    r.engaged = _mm_castsi128_pd(_mm_xor_si128(null, _mm_set1_epi32(-1)));
+    return r;
+  }
+
+  struct int32_quad
+  {
+    __m128i values;
+    __m128i engaged;
+  };
+  // p[0] .. p[3]
+  inline int32_quad load_sse2(const optional<int32_t>* p)
+  {
+    const __m128i* q = reinterpret_cast<const __m128i*>(p);
+    __m128i o0 = _mm_loadu_si128(q);
+    __m128i o1 = _mm_loadu_si128(q + 1);
+    __m128i o2 = _mm_loadu_si128(q + 2);
+    __m128i o3 = _mm_loadu_si128(q + 3);
+    // each optional is [value, padding, pointer low, pointer high]
+    __m128i lo = _mm_unpackhi_epi32(o0, o1);
+    __m128i hi = _mm_unpackhi_epi32(o2, o3);
+    __m128i pointers = _mm_or_si128(_mm_unpacklo_epi64(lo, hi), _mm_unpackhi_epi64(lo, hi));
+    int32_quad r;
+    r.values = _mm_unpacklo_epi64(_mm_unpacklo_epi32(o0, o1), _mm_unpacklo_epi32(o2, o3));
+    r.engaged = _mm_xor_si128(_mm_cmpeq_epi32(pointers, _mm_setzero_si128()), _mm_set1_epi32(-1));
+    return r;
+  }
+
+  std::size_t count_engaged_sse2(const optional<double>* p, std::size_t n)
+  {
+    std::size_t count = 0, i = 0;
+    for (; i + 2 <= n; i += 2) count += count_bits(_mm_movemask_pd(load_sse2(p + i).engaged));
+    return count + count_engaged_scalar(p + i, n - i);
+  }
+  std::size_t count_engaged_sse2(const optional<int32_t>* p, std::size_t n)
+  {
+    std::size_t count = 0, i = 0;
+    for (; i + 4 <= n; i += 4) count += count_bits(_mm_movemask_ps(_mm_castsi128_ps(load_sse2(p + i).engaged)));
+    return count + count_engaged_scalar(p + i, n - i);
+  }
+
+  double sum_engaged_sse2(const optional<double>* p, std::size_t n)
+  {
+    __m128d sum01 = _mm_setzero_pd(), sum23 = _mm_setzero_pd();
+    std::size_t i = 0;
+    for (; i + 4 <= n; i += 4)
+    {
+      double_pair a = load_sse2(p + i), b = load_sse2(p + i + 2);
+      sum01 = _mm_add_pd(sum01, _mm_and_pd(a.values, a.engaged));
+      sum23 = _mm_add_pd(sum23, _mm_and_pd(b.values, b.engaged));
+    }
+    double partial[4];
+    _mm_storeu_pd(partial, sum01);
+    _mm_storeu_pd(partial + 2, sum23);
+    return sum_partials(p, i, n, partial);
+  }
+  int32_t sum_engaged_sse2(const optional<int32_t>* p, std::size_t n)
+  {
+    __m128i sum = _mm_setzero_si128();
+    std::size_t i = 0;
+    for (; i + 4 <= n; i += 4)
+    {
+      int32_quad a = load_sse2(p + i);
+      sum = _mm_add_epi32(sum, _mm_and_si128(a.values, a.engaged));
+    }
+    uint32_t lanes[4];
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(lanes), sum);
+    uint32_t total = lanes[0] + lanes[1] + lanes[2] + lanes[3] + static_cast<uint32_t>(sum_engaged_scalar(p + i, n - i));
+    return static_cast<int32_t>(total);
+  }
+
+  void fill_value_or_sse2(const optional<double>* p, std::size_t n, double* out, double val)
+  {
+    __m128d fill = _mm_set1_pd(val);
+    std::size_t i = 0;
+    for (; i + 2 <= n; i += 2)
+    {
+      double_pair a = load_sse2(p + i);
+      _mm_storeu_pd(out + i, _mm_or_pd(_mm_and_pd(a.engaged, a.values), _mm_andnot_pd(a.engaged, fill)));
+    }
+    fill_value_or_scalar(p + i, n - i, out + i, val);
+  }
+  void fill_value_or_sse2(const optional<int32_t>* p, std::size_t n, int32_t* out, int32_t val)
+  {
+    __m128i fill = _mm_set1_epi32(val);
+    std::size_t i = 0;
+    for (; i + 4 <= n; i += 4)
+    {
+      int32_quad a = load_sse2(p + i);
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_or_si128(_mm_and_si128(a.engaged, a.values), _mm_andnot_si128(a.engaged, fill)));
+    }
+    fill_value_or_scalar(p + i, n - i, out + i, val);
+  }
+
+  bool equal_ranges_sse2(const optional<double>* p, const optional<double>* q, std::size_t n)
+  {
+    std::size_t i = 0;
+    for (; i + 2 <= n; i += 2)
+    {
+      double_pair a = load_sse2(p + i), b = load_sse2(q + i);
+      // engaged states agree, and either both are null or the values compare equal
+      __m128d same_state = _mm_xor_pd(_mm_xor_pd(a.engaged, b.engaged), _mm_castsi128_pd(_mm_set1_epi32(-1)));
+      __m128d same_value = _mm_or_pd(_mm_andnot_pd(a.engaged, same_state), _mm_cmpeq_pd(a.values, b.values));
+      if (_mm_movemask_pd(_mm_and_pd(same_state, same_value)) != 0x3) return false;
+    }
+    return equal_ranges_scalar(p + i, q + i, n - i);
+  }
+  bool equal_ranges_sse2(const optional<int32_t>* p, const optional<int32_t>* q, std::size_t n)
+  {
+    std::size_t i = 0;
+    for (; i + 4 <= n; i += 4)
+    {
+      int32_quad a = load_sse2(p + i), b = load_sse2(q + i);
+      __m128i same_state = _mm_xor_si128(_mm_xor_si128(a.engaged, b.engaged), _mm_set1_epi32(-1));
+      __m128i same_value = _mm_or_si128(_mm_andnot_si128(a.engaged, same_state), _mm_cmpeq_epi32(a.values, b.values));
+      if (_mm_movemask_epi8(_mm_and_si128(same_state, same_value)) != 0xffff) return false;
+    }
+    return equal_ranges_scalar(p + i, q + i, n - i);
+  }
+
+  template <bool Max>
+  double reduce_sse2(const optional<double>* p, std::size_t n)
+  {
+    const double identity = Max ? -__builtin_inf() : __builtin_inf();
+    __m128d fill = _mm_set1_pd(identity);
+    __m128d acc = fill;
+    std::size_t i = 0;
+    for (; i + 2 <= n; i += 2)
+    {
+      double_pair a = load_sse2(p + i);
+      __m128d use = _mm_and_pd(a.engaged, _mm_cmpord_pd(a.values, a.values));
+      __m128d v = _mm_or_pd(_mm_and_pd(use, a.values), _mm_andnot_pd(use, fill));
+      acc = Max ? _mm_max_pd(acc, v) : _mm_min_pd(acc, v);
+    }
+    double lanes[2];
+    _mm_storeu_pd(lanes, acc);
+    double result = Max ? (lanes[0] < lanes[1] ? lanes[1] : lanes[0]) : (lanes[1] < lanes[0] ? lanes[1] : lanes[0]);
+    for (; i < n; ++i)
+    {
+      if (p[i] && (Max ? result < *p[i] : *p[i] < result)) result = *p[i];
+    }
+    return result;
+  }
+  bool min_engaged_sse2(const optional<double>* p, std::size_t n, double* out) { return extreme_engaged<&reduce_sse2<false> >(p, n, out); }
+  bool max_engaged_sse2(const optional<double>* p, std::size_t n, double* out) { return extreme_engaged<&reduce_sse2<true> >(p, n, out); }
+
+  template <bool Max>
+  bool extreme_engaged_sse2(const optional<int32_t>* p, std::size_t n, int32_t* out)
+  {
+    // SSE2 has no 32bit min / max, select through a compare
+    __m128i fill = _mm_set1_epi32(Max ? std::numeric_limits<int32_t>::min() : std::numeric_limits<int32_t>::max());
+    __m128i acc = fill, any = _mm_setzero_si128();
+    std::size_t i = 0;
+    for (; i + 4 <= n; i += 4)
+    {
+      int32_quad a = load_sse2(p + i);
+      __m128i v = _mm_or_si128(_mm_and_si128(a.engaged, a.values), _mm_andnot_si128(a.engaged, fill));
+      __m128i take = Max ? _mm_cmpgt_epi32(v, acc) : _mm_cmpgt_epi32(acc, v);
+      acc = _mm_or_si128(_mm_and_si128(take, v), _mm_andnot_si128(take, acc));
+      any = _mm_or_si128(any, a.engaged);
+    }
+    int32_t lanes[4];
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(lanes), acc);
+    optional<int32_t> result;
+    if (_mm_movemask_epi8(any))
+    {
+      result = lanes[0];
+      for (int k = 1; k < 4; ++k)
+      {
+        if (Max ? *result < lanes[k] : lanes[k] < *result) *result = lanes[k];
+      }
+    }
+    for (; i < n; ++i)
+    {
+      if (p[i] && (!result || (Max ? *result < *p[i] : *p[i] < *result))) result = *p[i];
+    }
+    if (result) *out = *result;
+    return result.has_value();
+  }
+  bool min_engaged_sse2(const optional<int32_t>* p, std::size_t n, int32_t* out) { return extreme_engaged_sse2<false>(p, n, out); }
+  bool max_engaged_sse2(const optional<int32_t>* p, std::size_t n, int32_t* out) { return extreme_engaged_sse2<true>(p, n, out); }
+
+  template <class T>
+  struct sse2_kernels
+  {
+    static const optional_kernels<T> table;
+  };
+  template <class T>
+  const optional_kernels<T> sse2_kernels<T>::table = {
+    &count_engaged_sse2,
+    &sum_engaged_sse2,
+    &fill_value_or_sse2,
+    &equal_ranges_sse2,
+    &min_engaged_sse2,
+    &max_engaged_sse2
+  };
+
+  // ---- AVX2 ----
+
+  struct double_quad
+  {
+    __m256d values;  // p[0], p[2], p[1], p[3]
+    __m256d engaged;
+  };
+  MY_TARGET_AVX2 inline double_quad load_avx2(const optional<double>* p)
+  {
+    __m256d o01 = _mm256_loadu_pd(reinterpret_cast<const double*>(p));
+    __m256d o23 = _mm256_loadu_pd(reinterpret_cast<const double*>(p + 2));
+    __m256i null = _mm256_cmpeq_epi64(_mm256_castpd_si256(_mm256_unpackhi_pd(o01, o23)), _mm256_setzero_si256());
+    double_quad r;
+    r.values = _mm256_unpacklo_pd(o01, o23);
+    r.engaged = _mm256_castsi256_pd(_mm256_xor_si256(null, _mm256_set1_epi32(-1)));
+    return r;
+  }
+
+  struct int32_oct
+  {
+    __m256i values;  // p[0], p[2], p[4], p[6], p[1], p[3], p[5], p[7]
+    __m256i engaged;
+  };
+  MY_TARGET_AVX2 inline int32_oct load_avx2(const optional<int32_t>* p)
+  {
+    const __m256i* q = reinterpret_cast<const __m256i*>(p);
+    __m256i o01 = _mm256_loadu_si256(q);
+    __m256i o23 = _mm256_loadu_si256(q + 1);
+    __m256i o45 = _mm256_loadu_si256(q + 2);
+    __m256i o67 = _mm256_loadu_si256(q + 3);
+    __m256i lo = _mm256_unpackhi_epi32(o01, o23);
+    __m256i hi = _mm256_unpackhi_epi32(o45, o67);
+    __m256i pointers = _mm256_or_si256(_mm256_unpacklo_epi64(lo, hi), _mm256_unpackhi_epi64(lo, hi));
+    int32_oct r;
+    r.values = _mm256_unpacklo_epi64(_mm256_unpacklo_epi32(o01, o23), _mm256_unpacklo_epi32(o45, o67));
+    r.engaged = _mm256_xor_si256(_mm256_cmpeq_epi32(pointers, _mm256_setzero_si256()), _mm256_set1_epi32(-1));
+    return r;
+  }
+
+  MY_TARGET_AVX2 std::size_t count_engaged_avx2(const optional<double>* p, std::size_t n)
+  {
+    std::size_t count = 0, i = 0;
+    for (; i + 4 <= n; i += 4) count += count_bits(_mm256_movemask_pd(load_avx2(p + i).engaged));
+    return count + count_engaged_scalar(p + i, n - i);
+  }
+  MY_TARGET_AVX2 std::size_t count_engaged_avx2(const optional<int32_t>* p, std::size_t n)
+  {
+    std::size_t count = 0, i = 0;
+    for (; i + 8 <= n; i += 8) count += count_bits(_mm256_movemask_ps(_mm256_castsi256_ps(load_avx2(p + i).engaged)));
+    return count + count_engaged_scalar(p + i, n - i);
+  }
+
+  MY_TARGET_AVX2 double sum_engaged_avx2(const optional<double>* p, std::size_t n)
+  {
+    __m256d sum = _mm256_setzero_pd();
+    std::size_t i = 0;
+    for (; i + 4 <= n; i += 4)
+    {
+      double_quad a = load_avx2(p + i);
+      sum = _mm256_add_pd(sum, _mm256_and_pd(a.values, a.engaged));
+    }
+    double lanes[4];
+    _mm256_storeu_pd(lanes, sum);
+    double partial[4] = { lanes[0], lanes[2], lanes[1], lanes[3] };
+    return sum_partials(p, i, n, partial);
+  }
+  MY_TARGET_AVX2 int32_t sum_engaged_avx2(const optional<int32_t>* p, std::size_t n)
+  {
+    __m256i sum = _mm256_setzero_si256();
+    std::size_t i = 0;
+    for (; i + 8 <= n; i += 8)
+    {
+      int32_oct a = load_avx2(p + i);
+      sum = _mm256_add_epi32(sum, _mm256_and_si256(a.values, a.engaged));
+    }
+    uint32_t lanes[8];
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(lanes), sum);
+    uint32_t total = static_cast<uint32_t>(sum_engaged_scalar(p + i, n - i));
+    for (int k = 0; k < 8; ++k) total += lanes[k];
+    return static_cast<int32_t>(total);
+  }
+
+  MY_TARGET_AVX2 void fill_value_or_avx2(const optional<double>* p, std::size_t n, double* out, double val)
+  {
+    __m256d fill = _mm256_set1_pd(val);
+    std::size_t i = 0;
+    for (; i + 4 <= n; i += 4)
+    {
+      double_quad a = load_avx2(p + i);
+      __m256d r = _mm256_blendv_pd(fill, a.values, a.engaged);
+      _mm256_storeu_pd(out + i, _mm256_permute4x64_pd(r, _MM_SHUFFLE(3, 1, 2, 0)));
+    }
+    fill_value_or_scalar(p + i, n - i, out + i, val);
+  }
+  MY_TARGET_AVX2 void fill_value_or_avx2(const optional<int32_t>* p, std::size_t n, int32_t* out, int32_t val)
+  {
+    __m256i fill = _mm256_set1_epi32(val);
+    __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+    std::size_t i = 0;
+    for (; i + 8 <= n; i += 8)
+    {
+      int32_oct a = load_avx2(p + i);
+      __m256i r = _mm256_blendv_epi8(fill, a.values, a.engaged);
+      _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), _mm256_permutevar8x32_epi32(r, order));
+    }
+    fill_value_or_scalar(p + i, n - i, out + i, val);
+  }
+
+  MY_TARGET_AVX2 bool equal_ranges_avx2(const optional<double>* p, const optional<double>* q, std::size_t n)
+  {
+    std::size_t i = 0;
+    for (; i + 4 <= n; i += 4)
+    {
+      double_quad a = load_avx2(p + i), b = load_avx2(q + i);
+      __m256d same_state = _mm256_xor_pd(_mm256_xor_pd(a.engaged, b.engaged), _mm256_castsi256_pd(_mm256_set1_epi32(-1)));
+      __m256d same_value = _mm256_or_pd(_mm256_andnot_pd(a.engaged, same_state), _mm256_cmp_pd(a.values, b.values, _CMP_EQ_OQ));
+      if (_mm256_movemask_pd(_mm256_and_pd(same_state, same_value)) != 0xf) return false;
+    }
+    return equal_ranges_scalar(p + i, q + i, n - i);
+  }
+  MY_TARGET_AVX2 bool equal_ranges_avx2(const optional<int32_t>* p, const optional<int32_t>* q, std::size_t n)
+  {
+    std::size_t i = 0;
+    for (; i + 8 <= n; i += 8)
+    {
+      int32_oct a = load_avx2(p + i), b = load_avx2(q + i);
+      __m256i same_state = _mm256_xor_si256(_mm256_xor_si256(a.engaged, b.engaged), _mm256_set1_epi32(-1));
+      __m256i same_value = _mm256_or_si256(_mm256_andnot_si256(a.engaged, same_state), _mm256_cmpeq_epi32(a.values, b.values));
+      if (_mm256_movemask_epi8(_mm256_and_si256(same_state, same_value)) != -1) return false;
+    }
+    return equal_ranges_scalar(p + i, q + i, n - i);
+  }
+
+  template <bool Max>
+  MY_TARGET_AVX2 double reduce_avx2(const optional<double>* p, std::size_t n)
+  {
+    const double identity = Max ? -__builtin_inf() : __builtin_inf();
+    __m256d fill = _mm256_set1_pd(identity);
+    __m256d acc = fill;
+    std::size_t i = 0;
+    for (; i + 4 <= n; i += 4)
+    {
+      double_quad a = load_avx2(p + i);
+      __m256d use = _mm256_and_pd(a.engaged, _mm256_cmp_pd(a.values, a.values, _CMP_ORD_Q));
+      __m256d v = _mm256_blendv_pd(fill, a.values, use);
+      acc = Max ? _mm256_max_pd(acc, v) : _mm256_min_pd(acc, v);
+    }
+    double lanes[4];
+    _mm256_storeu_pd(lanes, acc);
+    double result = identity;
+    for (int k = 0; k < 4; ++k)
+    {
+      if (Max ? result < lanes[k] : lanes[k] < result) result = lanes[k];
+    }
+    for (; i < n; ++i)
+    {
+      if (p[i] && (Max ? result < *p[i] : *p[i] < result)) result = *p[i];
+    }
+    return result;
+  }
+  bool min_engaged_avx2(const optional<double>* p, std::size_t n, double* out) { return extreme_engaged<&reduce_avx2<false> >(p, n, out); }
+  bool max_engaged_avx2(const optional<double>* p, std::size_t n, double* out) { return extreme_engaged<&reduce_avx2<true> >(p, n, out); }
+
+  template <bool Max>
+  MY_TARGET_AVX2 bool extreme_engaged_avx2(const optional<int32_t>* p, std::size_t n, int32_t* out)
+  {
+    __m256i fill = _mm256_set1_epi32(Max ? std::numeric_limits<int32_t>::min() : std::numeric_limits<int32_t>::max());
+    __m256i acc = fill, any = _mm256_setzero_si256();
+    std::size_t i = 0;
+    for (; i + 8 <= n; i += 8)
+    {
+      int32_oct a = load_avx2(p + i);
+      __m256i v = _mm256_blendv_epi8(fill, a.values, a.engaged);
+      acc = Max ? _mm256_max_epi32(acc, v) : _mm256_min_epi32(acc, v);
+      any = _mm256_or_si256(any, a.engaged);
+    }
+    int32_t lanes[8];
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(lanes), acc);
+    optional<int32_t> result;
+    if (!_mm256_testz_si256(any, any))
+    {
+      result = lanes[0];
+      for (int k = 1; k < 8; ++k)
+      {
+        if (Max ? *result < lanes[k] : lanes[k] < *result) *result = lanes[k];
+      }
+    }
+    for (; i < n; ++i)
+    {
+      if (p[i] && (!result || (Max ? *result < *p[i] : *p[i] < *result))) result = *p[i];
+    }
+    if (result) *out = *result;
+    return result.has_value();
+  }
+  bool min_engaged_avx2(const optional<int32_t>* p, std::size_t n, int32_t* out) { return extreme_engaged_avx2<false>(p, n, out); }
+  bool max_engaged_avx2(const optional<int32_t>* p, std::size_t n, int32_t* out) { return extreme_engaged_avx2<true>(p, n, out); }
+
+  template <class T>
+  struct avx2_kernels
+  {
+    static const optional_kernels<T> table;
+  };
+  template <class T>
+  const optional_kernels<T> avx2_kernels<T>::table = {
+    &count_engaged_avx2,
+    &sum_engaged_avx2,
+    &fill_value_or_avx2,
+    &equal_ranges_avx2,
+    &min_engaged_avx2,
+    &max_engaged_avx2
+  };
+
+  bool cpu_has_avx2()
+  {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+  }
+#endif
+
+  simd_level detect_simd_level()
+  {
+#if defined(MY_OPTIONAL_SIMD)
+    if (!has_kernel_layout(1.5) || !has_kernel_layout(static_cast<int32_t>(0x12345678))) return simd_scalar;
+    return cpu_has_avx2() ? simd_avx2 : simd_sse2;
+#else
+    return simd_scalar;
+#endif
+  }
+
+  template <class T>
+  const optional_kernels<T>* select_kernels(simd_level level)
+  {
+    if (level > detected_simd_level()) return NULL;
+    switch (level)
+    {
+#if defined(MY_OPTIONAL_SIMD)
+    case simd_avx2: return &avx2_kernels<T>::table;
+    case simd_sse2: return &sse2_kernels<T>::table;
+#endif
+    default: return &scalar_kernels<T>::table;
+    }
+  }
+}
+
+  simd_level detected_simd_level()
+  {
+    static const simd_level level = detect_simd_level();
+    return level;
+  }
+
+  template <>
+  const optional_kernels<double>* kernels_for<double>(simd_level level) { return select_kernels<double>(level); }
+  template <>
+  const optional_kernels<int32_t>* kernels_for<int32_t>(simd_level level) { return select_kernels<int32_t>(level); }
+}
+}
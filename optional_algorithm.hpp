@@ -0,0 +1,244 @@
+#ifndef OPTIONAL_ALGORITHM_HPP
+#define OPTIONAL_ALGORITHM_HPP
+
+#include <cstddef>
+#include <iterator>
+#include <stdint.h>
+#include "bool_tag.hpp"
+#include "is_same.hpp"
+#include "optional.hpp"
+
+// Range algorithms over sequences of optional.
+// Contiguous ranges of optional<double> / optional<int32_t> (pointers, and std::vector iterators on libstdc++)
+// are handed to SSE2 / AVX2 kernels selected at runtime, everything else uses the element-wise loops below.
+// Both paths give the same results as has_value(), value_or and operator== / operator< applied one by one,
+// except sum_engaged of double whose kernels add into 4 interleaved partial sums (see sum_engaged).
+
+namespace my
+{
+  namespace detail
+  {
+    using type_traits::bool_tag;
+    using type_traits::is_same;
+
+    template <class It>
+    struct contiguous_iterator { enum { value = false }; typedef void element_type; };
+    template <class T>
+    struct contiguous_iterator<T*>
+    {
+      enum { value = true };
+      typedef T element_type;
+      static T* address(T* it) MY_NOEXCEPT { return it; }
+    };
+#if defined(__GLIBCXX__)
+    template <class T, class Container>
+    struct contiguous_iterator<__gnu_cxx::__normal_iterator<T*, Container> >
+    {
+      enum { value = true };
+      typedef T element_type;
+      static T* address(const __gnu_cxx::__normal_iterator<T*, Container>& it) MY_NOEXCEPT { return it.base(); }
+    };
+#endif
+
+    // element types which have kernels
+    template <class Optional>
+    struct kernel_value { enum { value = false }; };
+    template <class Optional>
+    struct kernel_value<const Optional>: kernel_value<Optional> {};
+    template <>
+    struct kernel_value<optional<double> > { enum { value = true }; };
+    template <>
+    struct kernel_value<optional<int32_t> > { enum { value = true }; };
+
+    template <class It>
+    struct use_kernels
+    {
+      enum { value = contiguous_iterator<It>::value && kernel_value<typename contiguous_iterator<It>::element_type>::value };
+    };
+
+    enum simd_level { simd_scalar, simd_sse2, simd_avx2 };
+    simd_level detected_simd_level();
+
+    template <class T>
+    struct optional_kernels
+    {
+      std::size_t (*count_engaged)(const optional<T>*, std::size_t);
+      T (*sum_engaged)(const optional<T>*, std::size_t);
+      void (*fill_value_or)(const optional<T>*, std::size_t, T*, T);
+      bool (*equal_ranges)(const optional<T>*, const optional<T>*, std::size_t);
+      // return false if no element is engaged
+      bool (*min_engaged)(const optional<T>*, std::size_t, T*);
+      bool (*max_engaged)(const optional<T>*, std::size_t, T*);
+    };
+
+    // NULL if the level is not supported by this build or this CPU
+    template <class T>
+    const optional_kernels<T>* kernels_for(simd_level level);
+    template <>
+    const optional_kernels<double>* kernels_for<double>(simd_level level);
+    template <>
+    const optional_kernels<int32_t>* kernels_for<int32_t>(simd_level level);
+
+    template <class T>
+    const optional_kernels<T>& active_kernels() { return *kernels_for<T>(detected_simd_level()); }
+
+    template <class It>
+    const optional_kernels<typename std::iterator_traits<It>::value_type::value_type>& kernels_of(It)
+    {
+      return active_kernels<typename std::iterator_traits<It>::value_type::value_type>();
+    }
+    template <class It>
+    typename contiguous_iterator<It>::element_type* address(const It& it) { return contiguous_iterator<It>::address(it); }
+
+    template <class InputIt>
+    std::size_t count_engaged(InputIt first, InputIt last, bool_tag<false>)
+    {
+      std::size_t count = 0;
+      for (; first != last; ++first)
+      {
+        if (first->has_value()) ++count;
+      }
+      return count;
+    }
+    template <class It>
+    std::size_t count_engaged(It first, It last, bool_tag<true>)
+    {
+      return kernels_of(first).count_engaged(address(first), last - first);
+    }
+
+    template <class InputIt>
+    typename std::iterator_traits<InputIt>::value_type::value_type sum_engaged(InputIt first, InputIt last, bool_tag<false>)
+    {
+      typename std::iterator_traits<InputIt>::value_type::value_type sum = typename std::iterator_traits<InputIt>::value_type::value_type();
+      for (; first != last; ++first)
+      {
+        if (first->has_value()) sum += **first;
+      }
+      return sum;
+    }
+    template <class It>
+    typename std::iterator_traits<It>::value_type::value_type sum_engaged(It first, It last, bool_tag<true>)
+    {
+      return kernels_of(first).sum_engaged(address(first), last - first);
+    }
+
+    template <class InputIt, class OutputIt, class U>
+    OutputIt fill_value_or(InputIt first, InputIt last, OutputIt out, const U& val, bool_tag<false>)
+    {
+      for (; first != last; ++first, ++out) *out = first->value_or(val);
+      return out;
+    }
+    template <class It, class OutputIt, class U>
+    OutputIt fill_value_or(It first, It last, OutputIt out, const U& val, bool_tag<true>)
+    {
+      typedef typename std::iterator_traits<It>::value_type::value_type value_type;
+      std::size_t n = last - first;
+      kernels_of(first).fill_value_or(address(first), n, address(out), value_type(val));
+      return out + n;
+    }
+
+    template <class InputIt1, class InputIt2>
+    bool equal_ranges(InputIt1 first1, InputIt1 last1, InputIt2 first2, bool_tag<false>)
+    {
+      for (; first1 != last1; ++first1, ++first2)
+      {
+        if (!(*first1 == *first2)) return false;
+      }
+      return true;
+    }
+    template <class It1, class It2>
+    bool equal_ranges(It1 first1, It1 last1, It2 first2, bool_tag<true>)
+    {
+      return kernels_of(first1).equal_ranges(address(first1), address(first2), last1 - first1);
+    }
+
+    // first smallest / largest engaged element, as std::min_element / std::max_element with operator<
+    template <class ForwardIt>
+    optional<typename std::iterator_traits<ForwardIt>::value_type::value_type> min_engaged(ForwardIt first, ForwardIt last, bool_tag<false>)
+    {
+      ForwardIt best = last;
+      for (; first != last; ++first)
+      {
+        if (first->has_value() && (best == last || **first < **best)) best = first;
+      }
+      if (best == last) return nullopt;
+      return **best;
+    }
+    template <class ForwardIt>
+    optional<typename std::iterator_traits<ForwardIt>::value_type::value_type> max_engaged(ForwardIt first, ForwardIt last, bool_tag<false>)
+    {
+      ForwardIt best = last;
+      for (; first != last; ++first)
+      {
+        if (first->has_value() && (best == last || **best < **first)) best = first;
+      }
+      if (best == last) return nullopt;
+      return **best;
+    }
+    template <class It>
+    optional<typename std::iterator_traits<It>::value_type::value_type> min_engaged(It first, It last, bool_tag<true>)
+    {
+      typename std::iterator_traits<It>::value_type::value_type result;
+      if (kernels_of(first).min_engaged(address(first), last - first, &result)) return result;
+      return nullopt;
+    }
+    template <class It>
+    optional<typename std::iterator_traits<It>::value_type::value_type> max_engaged(It first, It last, bool_tag<true>)
+    {
+      typename std::iterator_traits<It>::value_type::value_type result;
+      if (kernels_of(first).max_engaged(address(first), last - first, &result)) return result;
+      return nullopt;
+    }
+  }
+
+  template <class InputIt>
+  std::size_t count_engaged(InputIt first, InputIt last)
+  {
+    return detail::count_engaged(first, last, detail::bool_tag<detail::use_kernels<InputIt>::value>());
+  }
+
+  // Overflow of integer sums is not defined, as for the built-in +=.
+  // Kernels for double add element i into partial sum i % 4 and return (s0 + s1) + (s2 + s3),
+  // so the result is the same on every CPU but may differ in the last bits from a sequential loop.
+  template <class InputIt>
+  typename std::iterator_traits<InputIt>::value_type::value_type sum_engaged(InputIt first, InputIt last)
+  {
+    return detail::sum_engaged(first, last, detail::bool_tag<detail::use_kernels<InputIt>::value>());
+  }
+
+  // writes value_or(val) of every element to out
+  template <class InputIt, class OutputIt, class U>
+  OutputIt fill_value_or(InputIt first, InputIt last, OutputIt out, const U& val)
+  {
+    typedef typename std::iterator_traits<InputIt>::value_type::value_type value_type;
+    return detail::fill_value_or(first, last, out, val, detail::bool_tag<
+      detail::use_kernels<InputIt>::value &&
+      detail::contiguous_iterator<OutputIt>::value &&
+      detail::is_same<typename detail::contiguous_iterator<OutputIt>::element_type, value_type>::value
+    >());
+  }
+
+  // element-wise operator==, the second range must be at least as long as the first
+  template <class InputIt1, class InputIt2>
+  bool equal_ranges(InputIt1 first1, InputIt1 last1, InputIt2 first2)
+  {
+    return detail::equal_ranges(first1, last1, first2, detail::bool_tag<
+      detail::use_kernels<InputIt1>::value &&
+      detail::use_kernels<InputIt2>::value &&
+      detail::is_same<typename std::iterator_traits<InputIt1>::value_type, typename std::iterator_traits<InputIt2>::value_type>::value
+    >());
+  }
+
+  template <class ForwardIt>
+  optional<typename std::iterator_traits<ForwardIt>::value_type::value_type> min_engaged(ForwardIt first, ForwardIt last)
+  {
+    return detail::min_engaged(first, last, detail::bool_tag<detail::use_kernels<ForwardIt>::value>());
+  }
+  template <class ForwardIt>
+  optional<typename std::iterator_traits<ForwardIt>::value_type::value_type> max_engaged(ForwardIt first, ForwardIt last)
+  {
+    return detail::max_engaged(first, last, detail::bool_tag<detail::use_kernels<ForwardIt>::value>());
+  }
+}
+
+#endif
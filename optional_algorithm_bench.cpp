@@ -0,0 +1,125 @@
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include <time.h>
+#include "optional_algorithm.hpp"
+
+// Times the element-wise loops (has_value, value_or, operator==) against each kernel level on
+// std::vector<optional<T> > columns with 20% nulls.
+
+namespace
+{
+  const std::size_t column_size = 1 << 20;
+  const int repeats = 50;
+
+  unsigned long long now_ns()
+  {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<unsigned long long>(ts.tv_sec) * 1000000000ULL + ts.tv_nsec;
+  }
+
+  // keeps results alive so the loops are not optimized away
+  volatile double sink;
+
+  template <class T>
+  std::vector<my::optional<T> > make_column(unsigned seed)
+  {
+    std::srand(seed);
+    std::vector<my::optional<T> > column(column_size);
+    for (std::size_t i = 0; i < column.size(); ++i)
+    {
+      if (std::rand() % 5) column[i] = static_cast<T>(std::rand() % 2001 - 1000);
+    }
+    return column;
+  }
+
+  template <class T>
+  struct benchmark
+  {
+    const std::vector<my::optional<T> >& a;
+    const std::vector<my::optional<T> >& b;
+    std::vector<T>& out;
+    const my::detail::optional_kernels<T>* kernels; // NULL runs the element-wise loops
+
+    double count() const
+    {
+      if (kernels) return kernels->count_engaged(&a[0], a.size());
+      return my::detail::count_engaged(a.begin(), a.end(), my::detail::bool_tag<false>());
+    }
+    double sum() const
+    {
+      if (kernels) return kernels->sum_engaged(&a[0], a.size());
+      return my::detail::sum_engaged(a.begin(), a.end(), my::detail::bool_tag<false>());
+    }
+    double fill() const
+    {
+      if (kernels) kernels->fill_value_or(&a[0], a.size(), &out[0], T(0));
+      else my::detail::fill_value_or(a.begin(), a.end(), out.begin(), T(0), my::detail::bool_tag<false>());
+      return out[out.size() / 2];
+    }
+    double equal() const
+    {
+      if (kernels) return kernels->equal_ranges(&a[0], &b[0], a.size());
+      return my::detail::equal_ranges(a.begin(), a.end(), b.begin(), my::detail::bool_tag<false>());
+    }
+    double min() const
+    {
+      T m = T();
+      if (kernels) kernels->min_engaged(&a[0], a.size(), &m);
+      else m = *my::detail::min_engaged(a.begin(), a.end(), my::detail::bool_tag<false>());
+      return m;
+    }
+    double max() const
+    {
+      T m = T();
+      if (kernels) kernels->max_engaged(&a[0], a.size(), &m);
+      else m = *my::detail::max_engaged(a.begin(), a.end(), my::detail::bool_tag<false>());
+      return m;
+    }
+  };
+
+  template <class T>
+  double time_ns_per_element(const benchmark<T>& bench, double (benchmark<T>::*op)() const)
+  {
+    unsigned long long start = now_ns();
+    for (int r = 0; r < repeats; ++r) sink = (bench.*op)();
+    return static_cast<double>(now_ns() - start) / (static_cast<double>(column_size) * repeats);
+  }
+
+  template <class T>
+  void run(const char* type_name)
+  {
+    std::vector<my::optional<T> > a = make_column<T>(1), b = a;
+    std::vector<T> out(column_size);
+    const char* level_names[] = { "scalar", "sse2", "avx2" };
+    const char* op_names[] = { "count_engaged", "sum_engaged", "fill_value_or", "equal_ranges", "min_engaged", "max_engaged" };
+    double (benchmark<T>::*ops[])() const = {
+      &benchmark<T>::count, &benchmark<T>::sum, &benchmark<T>::fill, &benchmark<T>::equal, &benchmark<T>::min, &benchmark<T>::max
+    };
+
+    std::printf("optional<%s>, %lu elements, ns/element\n", type_name, static_cast<unsigned long>(column_size));
+    std::printf("%-16s %10s", "", "loop");
+    for (int level = my::detail::simd_scalar; level <= my::detail::simd_avx2; ++level) std::printf(" %10s", level_names[level]);
+    std::printf("\n");
+    for (int op = 0; op < 6; ++op)
+    {
+      benchmark<T> loop = { a, b, out, NULL };
+      std::printf("%-16s %10.3f", op_names[op], time_ns_per_element(loop, ops[op]));
+      for (int level = my::detail::simd_scalar; level <= my::detail::simd_avx2; ++level)
+      {
+        benchmark<T> bench = { a, b, out, my::detail::kernels_for<T>(static_cast<my::detail::simd_level>(level)) };
+        if (bench.kernels) std::printf(" %10.3f", time_ns_per_element(bench, ops[op]));
+        else std::printf(" %10s", "n/a");
+      }
+      std::printf("\n");
+    }
+  }
+}
+
+int main()
+{
+  run<double>("double");
+  run<int32_t>("int32_t");
+  return 0;
+}
@@ -0,0 +1,173 @@
+#define BOOST_TEST_MAIN
+#include <boost/test/included/unit_test.hpp>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <limits>
+#include <vector>
+#include "optional_algorithm.hpp"
+
+using namespace my;
+using my::detail::simd_level;
+
+// the deque versions go through the element-wise loops and are the reference results
+template <class T>
+struct columns
+{
+  std::vector<optional<T> > vec;
+  std::deque<optional<T> > deq;
+  void push_back(const optional<T>& x) { vec.push_back(x); deq.push_back(x); }
+};
+
+template <class T>
+columns<T> random_column(std::size_t n, unsigned seed, int null_percent)
+{
+  std::srand(seed);
+  columns<T> c;
+  for (std::size_t i = 0; i < n; ++i)
+  {
+    if (std::rand() % 100 < null_percent) c.push_back(nullopt);
+    else c.push_back(static_cast<T>(std::rand() % 2001 - 1000));
+  }
+  return c;
+}
+
+bool same_bits(double x, double y) { return std::memcmp(&x, &y, sizeof(double)) == 0; }
+bool same_bits(int32_t x, int32_t y) { return x == y; }
+template <class T>
+bool same_bits(const optional<T>& x, const optional<T>& y) { return x.has_value() == y.has_value() && (!x || same_bits(*x, *y)); }
+template <class T>
+bool same_bits(const std::vector<T>& x, const T* y)
+{
+  for (std::size_t i = 0; i < x.size(); ++i)
+  {
+    if (!same_bits(x[i], y[i])) return false;
+  }
+  return true;
+}
+
+// runs every algorithm through every kernel level this CPU supports and compares with the reference
+template <class T>
+void check_kernels(const columns<T>& a, const columns<T>& b)
+{
+  const std::size_t n = a.vec.size();
+  const optional<T>* p = n ? &a.vec[0] : NULL;
+  const optional<T>* q = n ? &b.vec[0] : NULL;
+  const T fill = 7;
+
+  BOOST_CHECK_EQUAL(count_engaged(a.vec.begin(), a.vec.end()), count_engaged(a.deq.begin(), a.deq.end()));
+  BOOST_CHECK(same_bits(min_engaged(a.vec.begin(), a.vec.end()), min_engaged(a.deq.begin(), a.deq.end())));
+  BOOST_CHECK(same_bits(max_engaged(a.vec.begin(), a.vec.end()), max_engaged(a.deq.begin(), a.deq.end())));
+  BOOST_CHECK_EQUAL(equal_ranges(a.vec.begin(), a.vec.end(), b.vec.begin()), equal_ranges(a.deq.begin(), a.deq.end(), b.deq.begin()));
+  std::vector<T> filled(n), expected(n);
+  fill_value_or(a.vec.begin(), a.vec.end(), filled.begin(), fill);
+  fill_value_or(a.deq.begin(), a.deq.end(), expected.begin(), fill);
+  BOOST_CHECK(same_bits(expected, n ? &filled[0] : NULL));
+
+  const detail::optional_kernels<T>* scalar = detail::kernels_for<T>(detail::simd_scalar);
+  for (int level = detail::simd_scalar; level <= detail::simd_avx2; ++level)
+  {
+    const detail::optional_kernels<T>* k = detail::kernels_for<T>(static_cast<simd_level>(level));
+    if (!k) continue;
+    BOOST_TEST_CONTEXT("simd level " << level << ", size " << n)
+    {
+      BOOST_CHECK_EQUAL(k->count_engaged(p, n), count_engaged(a.deq.begin(), a.deq.end()));
+      BOOST_CHECK(same_bits(k->sum_engaged(p, n), scalar->sum_engaged(p, n)));
+      BOOST_CHECK_EQUAL(k->equal_ranges(p, q, n), equal_ranges(a.deq.begin(), a.deq.end(), b.deq.begin()));
+      BOOST_CHECK(k->equal_ranges(p, p, n) == equal_ranges(a.deq.begin(), a.deq.end(), a.deq.begin()));
+      std::vector<T> out(n + 1, 0);
+      k->fill_value_or(p, n, &out[0], fill);
+      BOOST_CHECK(same_bits(expected, &out[0]));
+      BOOST_CHECK_EQUAL(out[n], T(0));
+      T m;
+      optional<T> min_ref = min_engaged(a.deq.begin(), a.deq.end());
+      optional<T> max_ref = max_engaged(a.deq.begin(), a.deq.end());
+      BOOST_CHECK_EQUAL(k->min_engaged(p, n, &m), min_ref.has_value());
+      if (min_ref) BOOST_CHECK(same_bits(m, *min_ref));
+      BOOST_CHECK_EQUAL(k->max_engaged(p, n, &m), max_ref.has_value());
+      if (max_ref) BOOST_CHECK(same_bits(m, *max_ref));
+    }
+  }
+}
+
+template <class T>
+void check_random_columns()
+{
+  for (std::size_t n = 0; n < 40; ++n)
+  {
+    for (int nulls = 0; nulls <= 100; nulls += 25)
+    {
+      columns<T> a = random_column<T>(n, n * 101 + nulls, nulls);
+      check_kernels(a, a);
+      // values are small integers, so every summation order is exact
+      BOOST_CHECK(sum_engaged(a.vec.begin(), a.vec.end()) == sum_engaged(a.deq.begin(), a.deq.end()));
+      check_kernels(a, random_column<T>(n, n * 101 + nulls + 1, nulls));
+      // differ in one element only
+      for (std::size_t i = 0; i < n; i += 7)
+      {
+        columns<T> b = a;
+        b.vec[i] = b.vec[i] ? optional<T>(nullopt) : optional<T>(T(3));
+        b.deq[i] = b.vec[i];
+        check_kernels(a, b);
+      }
+    }
+  }
+}
+
+BOOST_AUTO_TEST_SUITE(my_optional_algorithm)
+BOOST_AUTO_TEST_CASE(generic) {
+  std::deque<optional<int> > column;
+  column.push_back(3);
+  column.push_back(nullopt);
+  column.push_back(-2);
+  column.push_back(5);
+  BOOST_CHECK_EQUAL(count_engaged(column.begin(), column.end()), 3u);
+  BOOST_CHECK_EQUAL(sum_engaged(column.begin(), column.end()), 6);
+  BOOST_CHECK(min_engaged(column.begin(), column.end()) == -2);
+  BOOST_CHECK(max_engaged(column.begin(), column.end()) == 5);
+  BOOST_CHECK(min_engaged(column.begin(), column.begin() + 0) == nullopt);
+  std::vector<long> filled(4);
+  fill_value_or(column.begin(), column.end(), filled.begin(), 0);
+  BOOST_CHECK_EQUAL(filled[1], 0);
+  BOOST_CHECK_EQUAL(filled[3], 5);
+  BOOST_CHECK(equal_ranges(column.begin(), column.end(), column.begin()));
+}
+BOOST_AUTO_TEST_CASE(int32_kernels) {
+  check_random_columns<int32_t>();
+
+  columns<int32_t> c;
+  for (int i = 0; i < 17; ++i) c.push_back(std::numeric_limits<int32_t>::max() - i);
+  c.push_back(std::numeric_limits<int32_t>::min());
+  check_kernels(c, c);
+}
+BOOST_AUTO_TEST_CASE(double_kernels) {
+  check_random_columns<double>();
+
+  const double nan = std::numeric_limits<double>::quiet_NaN();
+  const double inf = std::numeric_limits<double>::infinity();
+  // NaN first stays the minimum / maximum under operator<, NaN later is skipped
+  double first_nan[] = { nan, 1.0, -1.0, 2.0, 0.5, 3.0, -4.0, 9.0, 1.5 };
+  double late_nan[] = { 1.0, -1.0, nan, 2.0, 0.5, 3.0, -4.0, 9.0, 1.5 };
+  // the first of 0.0 and -0.0 is returned
+  double zeros[] = { 1.0, 0.0, 2.0, -0.0, 3.0, 4.0, 5.0, -0.0, 0.0, 6.0 };
+  double neg_zeros[] = { -0.0, 0.0, 2.0, 0.0, 3.0, 4.0, 5.0, -0.0, 0.0, 6.0 };
+  double infinities[] = { inf, inf, inf, inf, inf, -inf, -inf, -inf, -inf };
+  double* cases[] = { first_nan, late_nan, zeros, neg_zeros, infinities };
+  std::size_t sizes[] = { 9, 9, 10, 10, 9 };
+  for (std::size_t c = 0; c < 5; ++c)
+  {
+    columns<double> a;
+    for (std::size_t i = 0; i < sizes[c]; ++i) a.push_back(cases[c][i]);
+    check_kernels(a, a);
+    a.vec[0] = nullopt;
+    a.deq[0] = nullopt;
+    check_kernels(a, a);
+  }
+
+  // summation order is the same at every level
+  columns<double> fractions;
+  std::srand(1);
+  for (int i = 0; i < 1003; ++i) fractions.push_back(std::rand() % 5 ? optional<double>(std::rand() / 7.0) : optional<double>(nullopt));
+  check_kernels(fractions, fractions);
+}
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,50 @@
+#ifndef SPINLOCK_HPP
+#define SPINLOCK_HPP
+
+#if !defined(__GNUC__)
+#error "spinlock.hpp requires the GCC __sync builtins"
+#endif
+
+namespace my
+{
+  // test-and-test-and-set lock built on the GCC __sync builtins (C++03 has no <atomic>)
+  class spinlock
+  {
+  private:
+    volatile int flag;
+    spinlock(const spinlock&);
+    spinlock& operator=(const spinlock&);
+    static void relax() throw()
+    {
+#if defined(__i386__) || defined(__x86_64__)
+      __builtin_ia32_pause();
+#endif
+    }
+  public:
+    spinlock() throw(): flag(0) {}
+    bool try_lock() throw() { return __sync_lock_test_and_set(&flag, 1) == 0; }
+    void lock() throw()
+    {
+      while (!this->try_lock())
+      {
+        while (flag) relax();
+      }
+    }
+    void unlock() throw() { __sync_lock_release(&flag); }
+  };
+
+  template <class Lock>
+  class lock_guard
+  {
+  private:
+    Lock& target;
+    lock_guard(const lock_guard&);
+    lock_guard& operator=(const lock_guard&);
+  public:
+    explicit lock_guard(Lock& l): target(l) { target.lock(); }
+    ~lock_guard() throw() { target.unlock(); }
+  };
+}
+
+#endif
+